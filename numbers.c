@@ -1,13 +1,36 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <string.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 
 #define MAX_VALUE 32767  // Maximum value for 16-bit integers
 #define NUM_THREADS 8 // Number of threads
 
+#define SMALL_SEGMENT 32 // Segments up to this length use insertion sort
+#define LARGE_SEGMENT 65536 // Segments longer than this are split across workers
+#define SEGMENT_CHUNK 65536 // Minimum elements per histogram task of a large segment
+#define MAX_SEGMENT_CHUNKS (NUM_THREADS * 4) // Upper bound on tasks per large segment
+#define SEGMENTS_PER_BLOCK 64 // Segments handed out per initial task
+#define BATCH_LATENCY_CALLS 1000 // Single-segment calls timed in batch mode
+
+#define HISTOGRAM_SHARDS NUM_THREADS // Shards of the live histogram
+#define LIVE_BATCH 4096 // Values per producer batch in live mode
+#define LIVE_TOP_K 5 // Most frequent values reported in live mode
+
+#define MAX_WORKERS 64 // Upper bound on worker processes in shard mode
+#define SHARD_SAMPLES 64 // Keys each worker samples for splitter selection
+#define SMALL_PATH 256 // Buffer size for shard file names
+
 // Global array and its size
 int *globalArray;
 int arraySize;
@@ -23,10 +46,30 @@ typedef struct {
     int fillArray; // Flag to indicate if the thread should fill the array
 } ThreadArgs;
 
+// A run of elements inside a shared buffer, sorted independently by sortSegments
+typedef struct {
+    size_t offset;
+    size_t length;
+} Segment;
+
+// Persistent workers that sortSegments submits batches to
+typedef struct SortPool SortPool;
+
 // Function prototypes
 void *countingSortThread(void *args);
 void aggregateCounts(int counts[][MAX_VALUE + 1], int total_counts[]);
 void sortArray(int *array, int total_counts[]);
+SortPool *createSortPool(void);
+int sortSegments(SortPool *pool, int *buffer, const Segment *segments, size_t segmentCount);
+void destroySortPool(SortPool *pool);
+
+// Xorshift generator for threads and processes that each need their own stream
+unsigned int nextRandom(unsigned int *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
 
 void *fillArrayThread(void *args) {
     ThreadArgs *thread_args = (ThreadArgs *)args;
@@ -72,7 +115,1215 @@ void sortArray(int *array, int total_counts[]) {
     }
 }
 
-int main() {
+// ------------------------------
+// Segmented batch sort
+// ------------------------------
+
+typedef enum {
+    TASK_BLOCK, // Sort the small segments of one block inline
+    TASK_COUNT, // Histogram one chunk of a large segment
+    TASK_FILL   // Write one value range of a large segment back out
+} TaskType;
+
+// A large segment is sorted with the parallel histogram path: every chunk is
+// counted by its own task, and the last one to finish publishes the fill tasks
+typedef struct {
+    int *data;
+    size_t length;
+    int chunks;
+    size_t chunk_size;
+    int (*counts)[MAX_VALUE + 1]; // Per-chunk histograms
+    size_t starts[MAX_VALUE + 2]; // Output position of each value
+    int bounds[MAX_SEGMENT_CHUNKS + 1]; // Value range written by each fill task
+    atomic_int remaining; // Count tasks still running
+} LargeSegment;
+
+typedef struct {
+    TaskType type;
+    int index; // Block number for TASK_BLOCK, chunk number otherwise
+    LargeSegment *large;
+} Task;
+
+// Chase-Lev work-stealing deque: the owner pushes and pops at the bottom,
+// thieves take from the top. Capacity is fixed for the lifetime of a batch.
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    Task *tasks;
+    long mask;
+} TaskDeque;
+
+typedef struct {
+    int *buffer;
+    const Segment *segments;
+    size_t segmentCount;
+    TaskDeque deques[NUM_THREADS];
+    atomic_size_t pending; // Tasks pushed but not yet finished
+} Batch;
+
+typedef struct {
+    SortPool *pool;
+    Batch *batch;
+    int workerIndex;
+    int *scratch; // LARGE_SEGMENT elements for the inline radix sort
+} WorkerArgs;
+
+struct SortPool {
+    Batch batch; // Batch being sorted; deques are reused across batches
+    long capacity; // Current capacity of every deque
+    pthread_t threads[NUM_THREADS];
+    WorkerArgs workers[NUM_THREADS];
+    int started; // Workers actually running
+    pthread_mutex_t mutex;
+    pthread_cond_t batchReady; // Signalled when generation advances
+    pthread_cond_t batchDone; // Signalled when every worker has finished
+    unsigned long generation; // Batches submitted so far
+    int finished; // Workers done with the current batch
+    int shutdown;
+};
+
+void pushTask(TaskDeque *deque, Task task) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    deque->tasks[b & deque->mask] = task;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+int popTask(TaskDeque *deque, Task *task) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    *task = deque->tasks[b & deque->mask];
+    if (t == b) {
+        // Last task: race the thieves for it
+        int won = atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+int stealTask(TaskDeque *deque, Task *task) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return 0;
+    }
+
+    *task = deque->tasks[t & deque->mask];
+    return atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+        memory_order_seq_cst, memory_order_relaxed);
+}
+
+void insertionSort(int *data, size_t length) {
+    for (size_t i = 1; i < length; i++) {
+        int value = data[i];
+        size_t j = i;
+        while (j > 0 && data[j - 1] > value) {
+            data[j] = data[j - 1];
+            j--;
+        }
+        data[j] = value;
+    }
+}
+
+// Two-pass LSD radix sort over the 15 value bits; scratch must hold length elements
+void radixSort(int *data, size_t length, int *scratch) {
+    size_t low[256] = {0};
+    size_t high[(MAX_VALUE >> 8) + 1] = {0};
+
+    for (size_t i = 0; i < length; i++) {
+        low[data[i] & 0xFF]++;
+        high[data[i] >> 8]++;
+    }
+
+    size_t sum = 0;
+    for (int i = 0; i < 256; i++) {
+        size_t count = low[i];
+        low[i] = sum;
+        sum += count;
+    }
+    sum = 0;
+    for (int i = 0; i <= (MAX_VALUE >> 8); i++) {
+        size_t count = high[i];
+        high[i] = sum;
+        sum += count;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        scratch[low[data[i] & 0xFF]++] = data[i];
+    }
+    for (size_t i = 0; i < length; i++) {
+        data[high[scratch[i] >> 8]++] = scratch[i];
+    }
+}
+
+void sortSmallSegment(int *data, size_t length, int *scratch) {
+    if (length <= SMALL_SEGMENT) {
+        insertionSort(data, length);
+    } else {
+        radixSort(data, length, scratch);
+    }
+}
+
+// Runs on the worker that finished the last count task of a large segment
+void publishFillTasks(Batch *batch, TaskDeque *deque, LargeSegment *large) {
+    int chunks = large->chunks;
+
+    // Aggregate the chunk histograms into output positions
+    size_t position = 0;
+    for (int v = 0; v <= MAX_VALUE; v++) {
+        large->starts[v] = position;
+        for (int c = 0; c < chunks; c++) {
+            position += large->counts[c][v];
+        }
+    }
+    large->starts[MAX_VALUE + 1] = position;
+
+    // Split the value domain so every fill task writes about the same amount
+    int v = 0;
+    large->bounds[0] = 0;
+    for (int c = 1; c < chunks; c++) {
+        size_t target = large->length / chunks * c;
+        while (v <= MAX_VALUE && large->starts[v] < target) {
+            v++;
+        }
+        large->bounds[c] = v;
+    }
+    large->bounds[chunks] = MAX_VALUE + 1;
+
+    atomic_fetch_add(&batch->pending, chunks);
+    for (int c = 0; c < chunks; c++) {
+        Task task = { TASK_FILL, c, large };
+        pushTask(deque, task);
+    }
+}
+
+void runTask(WorkerArgs *worker, Task task) {
+    Batch *batch = worker->batch;
+
+    if (task.type == TASK_BLOCK) {
+        size_t first = (size_t)task.index * SEGMENTS_PER_BLOCK;
+        size_t last = first + SEGMENTS_PER_BLOCK;
+        if (last > batch->segmentCount) {
+            last = batch->segmentCount;
+        }
+        for (size_t i = first; i < last; i++) {
+            const Segment *segment = &batch->segments[i];
+            if (segment->length <= LARGE_SEGMENT) {
+                sortSmallSegment(batch->buffer + segment->offset, segment->length, worker->scratch);
+            }
+        }
+    } else if (task.type == TASK_COUNT) {
+        LargeSegment *large = task.large;
+        size_t start = task.index * large->chunk_size;
+        size_t end = start + large->chunk_size;
+        if (end > large->length) {
+            end = large->length;
+        }
+
+        int *counts = large->counts[task.index];
+        memset(counts, 0, sizeof(large->counts[0]));
+        for (size_t i = start; i < end; i++) {
+            counts[large->data[i]]++;
+        }
+
+        if (atomic_fetch_sub(&large->remaining, 1) == 1) {
+            publishFillTasks(batch, &batch->deques[worker->workerIndex], large);
+        }
+    } else {
+        LargeSegment *large = task.large;
+        for (int v = large->bounds[task.index]; v < large->bounds[task.index + 1]; v++) {
+            for (size_t i = large->starts[v]; i < large->starts[v + 1]; i++) {
+                large->data[i] = v;
+            }
+        }
+    }
+}
+
+void *segmentWorkerThread(void *args) {
+    WorkerArgs *worker = (WorkerArgs *)args;
+    SortPool *pool = worker->pool;
+    Batch *batch = worker->batch;
+    TaskDeque *own = &batch->deques[worker->workerIndex];
+    unsigned long seen = 0;
+    Task task;
+
+    while (1) {
+        // Park until the next batch is submitted
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->batchReady, &pool->mutex);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        while (atomic_load(&batch->pending) > 0) {
+            int found = popTask(own, &task);
+
+            // Own deque is empty: try to steal from the others
+            for (int i = 1; !found && i < NUM_THREADS; i++) {
+                found = stealTask(&batch->deques[(worker->workerIndex + i) % NUM_THREADS], &task);
+            }
+
+            if (!found) {
+                sched_yield();
+                continue;
+            }
+
+            runTask(worker, task);
+            atomic_fetch_sub(&batch->pending, 1);
+        }
+
+        // The submitter resets the deques only after every worker has left them
+        pthread_mutex_lock(&pool->mutex);
+        if (++pool->finished == NUM_THREADS) {
+            pthread_cond_signal(&pool->batchDone);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return NULL;
+}
+
+void destroySortPool(SortPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->batchReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        free(pool->workers[i].scratch);
+        free(pool->batch.deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->batchReady);
+    pthread_cond_destroy(&pool->batchDone);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+// Starts NUM_THREADS workers that stay parked between batches, so a call to
+// sortSegments pays no thread startup. Returns NULL if allocation fails.
+SortPool *createSortPool(void) {
+    SortPool *pool = calloc(1, sizeof(SortPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->batchReady, NULL);
+    pthread_cond_init(&pool->batchDone, NULL);
+    atomic_init(&pool->batch.pending, 0);
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        TaskDeque *deque = &pool->batch.deques[i];
+        atomic_init(&deque->top, 0);
+        atomic_init(&deque->bottom, 0);
+
+        pool->workers[i].pool = pool;
+        pool->workers[i].batch = &pool->batch;
+        pool->workers[i].workerIndex = i;
+        pool->workers[i].scratch = malloc(LARGE_SEGMENT * sizeof(int));
+        if (pool->workers[i].scratch == NULL) {
+            destroySortPool(pool);
+            return NULL;
+        }
+    }
+
+    for (; pool->started < NUM_THREADS; pool->started++) {
+        if (pthread_create(&pool->threads[pool->started], NULL, segmentWorkerThread,
+                           (void *)&pool->workers[pool->started]) != 0) {
+            destroySortPool(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+// Sorts every segment of buffer in place on the pool's workers and returns
+// once all of them are done. Values must lie in [0, MAX_VALUE].
+// Returns 0 on success, -1 if memory allocation fails.
+int sortSegments(SortPool *pool, int *buffer, const Segment *segments, size_t segmentCount) {
+    Batch *batch = &pool->batch;
+    size_t blockCount = (segmentCount + SEGMENTS_PER_BLOCK - 1) / SEGMENTS_PER_BLOCK;
+    size_t largeCount = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (segments[i].length > LARGE_SEGMENT) {
+            largeCount++;
+        }
+    }
+
+    // Every deque must be able to hold the whole batch plus all fill tasks.
+    // Workers are parked, so the deques can grow and reset here.
+    size_t maxTasks = blockCount + largeCount * MAX_SEGMENT_CHUNKS * 2;
+    long capacity = 1;
+    while ((size_t)capacity < maxTasks) {
+        capacity <<= 1;
+    }
+    if (capacity > pool->capacity) {
+        for (int i = 0; i < NUM_THREADS; i++) {
+            Task *tasks = realloc(batch->deques[i].tasks, capacity * sizeof(Task));
+            if (tasks == NULL) {
+                return -1;
+            }
+            batch->deques[i].tasks = tasks;
+            batch->deques[i].mask = capacity - 1;
+        }
+        pool->capacity = capacity;
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        atomic_store(&batch->deques[i].top, 0);
+        atomic_store(&batch->deques[i].bottom, 0);
+    }
+
+    LargeSegment *large = NULL;
+    if (largeCount > 0) {
+        large = calloc(largeCount, sizeof(LargeSegment));
+        if (large == NULL) {
+            return -1;
+        }
+    }
+    int result = -1;
+
+    batch->buffer = buffer;
+    batch->segments = segments;
+    batch->segmentCount = segmentCount;
+    atomic_store(&batch->pending, blockCount);
+
+    // Hand each worker a contiguous run of blocks to keep its segments local
+    for (int w = 0; w < NUM_THREADS; w++) {
+        size_t first = blockCount * w / NUM_THREADS;
+        size_t last = blockCount * (w + 1) / NUM_THREADS;
+        for (size_t b = first; b < last; b++) {
+            Task task = { TASK_BLOCK, (int)b, NULL };
+            pushTask(&batch->deques[w], task);
+        }
+    }
+
+    // Spread the chunks of large segments round-robin so no single worker owns one
+    size_t next = 0;
+    int worker = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (segments[i].length <= LARGE_SEGMENT) {
+            continue;
+        }
+
+        LargeSegment *segment = &large[next++];
+        segment->data = buffer + segments[i].offset;
+        segment->length = segments[i].length;
+        segment->chunks = (int)((segment->length + SEGMENT_CHUNK - 1) / SEGMENT_CHUNK);
+        if (segment->chunks > MAX_SEGMENT_CHUNKS) {
+            segment->chunks = MAX_SEGMENT_CHUNKS;
+        }
+        segment->chunk_size = (segment->length + segment->chunks - 1) / segment->chunks;
+        segment->counts = malloc(segment->chunks * sizeof(segment->counts[0]));
+        if (!segment->counts) {
+            goto cleanup;
+        }
+        atomic_init(&segment->remaining, segment->chunks);
+
+        atomic_fetch_add(&batch->pending, segment->chunks);
+        for (int c = 0; c < segment->chunks; c++) {
+            Task task = { TASK_COUNT, c, segment };
+            pushTask(&batch->deques[worker], task);
+            worker = (worker + 1) % NUM_THREADS;
+        }
+    }
+
+    // Wake the parked workers and wait until every one of them is done
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->batchReady);
+    while (pool->finished < NUM_THREADS) {
+        pthread_cond_wait(&pool->batchDone, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    result = 0;
+
+cleanup:
+    for (size_t i = 0; large && i < largeCount; i++) {
+        free(large[i].counts);
+    }
+    free(large);
+    return result;
+}
+
+int runBatchMode(void) {
+    struct timeval start, end;
+    double time_used;
+    int segmentCount, maxLength, hugeCount;
+
+    printf("\033[92m> numbers.c (batch)\n");
+    printf("\nEnter the number of segments: ");
+    if (scanf("%d", &segmentCount) != 1 || segmentCount < 1) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+    printf("Enter the maximum segment length: ");
+    if (scanf("%d", &maxLength) != 1 || maxLength < 1) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+    printf("Enter the number of huge segments: ");
+    if (scanf("%d", &hugeCount) != 1 || hugeCount < 0 || hugeCount > segmentCount) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+
+    // Lay the segments out back to back, with the huge ones spread evenly
+    Segment *segments = malloc(segmentCount * sizeof(Segment));
+    if (segments == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    size_t total = 0;
+    for (int i = 0; i < segmentCount; i++) {
+        int huge = hugeCount > 0 && i % (segmentCount / hugeCount) == 0
+            && i / (segmentCount / hugeCount) < hugeCount;
+        segments[i].offset = total;
+        segments[i].length = huge ? (size_t)LARGE_SEGMENT * 64 : (size_t)(rand() % maxLength) + 1;
+        total += segments[i].length;
+    }
+
+    int *buffer = malloc(total * sizeof(int));
+    if (buffer == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(segments);
+        return 1;
+    }
+
+    printf("\nFilling %zu elements with random 16-bit integers...\n", total);
+    for (size_t i = 0; i < total; i++) {
+        buffer[i] = rand() % (MAX_VALUE + 1);
+    }
+
+    SortPool *pool = createSortPool();
+    if (pool == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(buffer);
+        free(segments);
+        return 1;
+    }
+
+    printf("\nSorting %d segments...\n", segmentCount);
+    gettimeofday(&start, NULL);
+    if (sortSegments(pool, buffer, segments, segmentCount) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        destroySortPool(pool);
+        free(buffer);
+        free(segments);
+        return 1;
+    }
+    gettimeofday(&end, NULL);
+
+    // Verify every segment is in order
+    for (int i = 0; i < segmentCount; i++) {
+        const int *data = buffer + segments[i].offset;
+        for (size_t j = 1; j < segments[i].length; j++) {
+            if (data[j - 1] > data[j]) {
+                fprintf(stderr, "Segment %d is not sorted\n", i);
+                destroySortPool(pool);
+                free(buffer);
+                free(segments);
+                return 1;
+            }
+        }
+    }
+
+    // Tiny batches measure what a call costs once the pool is running
+    struct timeval call_start, call_end;
+    gettimeofday(&call_start, NULL);
+    for (int i = 0; i < BATCH_LATENCY_CALLS; i++) {
+        sortSegments(pool, buffer, &segments[i % segmentCount], 1);
+    }
+    gettimeofday(&call_end, NULL);
+    double call_time = (call_end.tv_sec - call_start.tv_sec) * 1000000.0
+        + (call_end.tv_usec - call_start.tv_usec);
+
+    destroySortPool(pool);
+    free(buffer);
+    free(segments);
+
+    time_used = (end.tv_sec - start.tv_sec) * 1000.0;    // sec to ms
+    time_used += (end.tv_usec - start.tv_usec) / 1000.0; // us to ms
+    time_used /= 1000.0;
+
+    printf("\n\033[92mSorted all segments!\n");
+    printf("\n\033[92m  - Execution time: %.3fms", time_used * 1000.0);
+    printf("\n\033[92m  - Throughput: %.0f segments/s", segmentCount / time_used);
+    printf("\n\033[92m  - Single-segment call: %.1fus\n\n", call_time / BATCH_LATENCY_CALLS);
+
+    return 0;
+}
+
+// ------------------------------
+// Live sharded histogram
+// ------------------------------
+
+// Producers never take a lock: each one adds into a shard with relaxed atomic
+// increments. Every shard keeps two count buffers, selected by the parity of
+// the histogram epoch. A snapshot flips the epoch, waits for writers still in
+// the old buffer to leave, and folds the now-quiescent buffer into running
+// totals. Every batch lands whole on one side of a snapshot.
+typedef struct {
+    _Alignas(64) atomic_uint writers[2]; // Producers inside each buffer
+    uint32_t counts[2][MAX_VALUE + 1]; // Updated with relaxed __atomic builtins
+} HistogramShard;
+
+typedef struct {
+    _Alignas(64) atomic_ulong epoch;
+    HistogramShard shards[HISTOGRAM_SHARDS];
+    pthread_mutex_t snapshot_mutex; // Serializes readers, never taken by writers
+    uint64_t totals[MAX_VALUE + 1]; // Everything folded in by past snapshots
+} LiveHistogram;
+
+typedef struct {
+    unsigned long epoch;
+    uint64_t total;
+    uint64_t counts[MAX_VALUE + 1];
+    uint64_t cumulative[MAX_VALUE + 2]; // Number of values below each value
+} HistogramSnapshot;
+
+LiveHistogram *createHistogram(void) {
+    LiveHistogram *histogram = aligned_alloc(64, sizeof(LiveHistogram));
+    if (histogram == NULL) {
+        return NULL;
+    }
+    memset(histogram, 0, sizeof(LiveHistogram));
+    atomic_init(&histogram->epoch, 0);
+    for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+        atomic_init(&histogram->shards[i].writers[0], 0);
+        atomic_init(&histogram->shards[i].writers[1], 0);
+    }
+    pthread_mutex_init(&histogram->snapshot_mutex, NULL);
+    return histogram;
+}
+
+void destroyHistogram(LiveHistogram *histogram) {
+    pthread_mutex_destroy(&histogram->snapshot_mutex);
+    free(histogram);
+}
+
+// Enters the buffer of the current epoch and returns its parity
+int enterShard(LiveHistogram *histogram, HistogramShard *shard) {
+    while (1) {
+        unsigned long epoch = atomic_load(&histogram->epoch);
+        int parity = epoch & 1;
+        atomic_fetch_add(&shard->writers[parity], 1);
+
+        // A snapshot may have flipped the epoch before we were counted
+        if (atomic_load(&histogram->epoch) == epoch) {
+            return parity;
+        }
+        atomic_fetch_sub_explicit(&shard->writers[parity], 1, memory_order_release);
+    }
+}
+
+// Values must lie in [0, MAX_VALUE]; shard is usually the producer's thread index
+void histogramAddBatch(LiveHistogram *histogram, int shard, const int *values, size_t length) {
+    HistogramShard *target = &histogram->shards[shard % HISTOGRAM_SHARDS];
+    int parity = enterShard(histogram, target);
+
+    uint32_t *counts = target->counts[parity];
+    for (size_t i = 0; i < length; i++) {
+        __atomic_fetch_add(&counts[values[i]], 1, __ATOMIC_RELAXED);
+    }
+
+    atomic_fetch_sub_explicit(&target->writers[parity], 1, memory_order_release);
+}
+
+void histogramAdd(LiveHistogram *histogram, int shard, int value) {
+    histogramAddBatch(histogram, shard, &value, 1);
+}
+
+// Takes a consistent snapshot without stopping producers
+void takeSnapshot(LiveHistogram *histogram, HistogramSnapshot *snapshot) {
+    pthread_mutex_lock(&histogram->snapshot_mutex);
+
+    unsigned long epoch = atomic_fetch_add(&histogram->epoch, 1);
+    int parity = epoch & 1;
+
+    for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+        HistogramShard *shard = &histogram->shards[i];
+
+        // Pairs with enterShard: both sides update one variable and then read
+        // the other, which is only safe if both reads are seq_cst
+        while (atomic_load_explicit(&shard->writers[parity], memory_order_seq_cst) != 0) {
+            sched_yield();
+        }
+
+        // No producer can enter this buffer until the next flip, so the merge
+        // is a plain loop the compiler vectorizes
+        uint32_t *counts = shard->counts[parity];
+        for (int v = 0; v <= MAX_VALUE; v++) {
+            histogram->totals[v] += counts[v];
+        }
+        memset(counts, 0, sizeof(shard->counts[parity]));
+    }
+
+    memcpy(snapshot->counts, histogram->totals, sizeof(snapshot->counts));
+    snapshot->epoch = epoch + 1;
+
+    pthread_mutex_unlock(&histogram->snapshot_mutex);
+
+    uint64_t sum = 0;
+    for (int v = 0; v <= MAX_VALUE; v++) {
+        snapshot->cumulative[v] = sum;
+        sum += snapshot->counts[v];
+    }
+    snapshot->cumulative[MAX_VALUE + 1] = sum;
+    snapshot->total = sum;
+}
+
+uint64_t snapshotCount(const HistogramSnapshot *snapshot, int value) {
+    return snapshot->counts[value];
+}
+
+// Number of recorded values strictly below value
+uint64_t snapshotRank(const HistogramSnapshot *snapshot, int value) {
+    return snapshot->cumulative[value];
+}
+
+// Smallest value with at least percentile% of the recorded values at or below it
+int snapshotPercentile(const HistogramSnapshot *snapshot, double percentile) {
+    if (snapshot->total == 0) {
+        return -1;
+    }
+
+    // Nearest rank: round up, then clamp to [1, total]. Multiplying before
+    // dividing keeps whole-number ranks such as 7% of 100 exact.
+    double rank = percentile * snapshot->total / 100.0;
+    uint64_t target = 1;
+    if (rank >= (double)snapshot->total) {
+        target = snapshot->total;
+    } else if (rank > 1.0) {
+        target = (uint64_t)rank;
+        if ((double)target < rank) {
+            target++;
+        }
+    }
+
+    // Binary search for the first value whose inclusive count reaches target
+    int low = 0, high = MAX_VALUE;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (snapshot->cumulative[mid + 1] >= target) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+// Fills the k most frequent values, most frequent first; returns how many were found
+int snapshotTopK(const HistogramSnapshot *snapshot, int k, int values[], uint64_t counts[]) {
+    int found = 0;
+    if (k <= 0) {
+        return 0;
+    }
+
+    // Keep the best k sorted by descending count with an insertion step
+    for (int v = 0; v <= MAX_VALUE; v++) {
+        uint64_t count = snapshot->counts[v];
+        if (count == 0 || (found == k && count <= counts[k - 1])) {
+            continue;
+        }
+
+        int i = found < k ? found++ : k - 1;
+        while (i > 0 && counts[i - 1] < count) {
+            values[i] = values[i - 1];
+            counts[i] = counts[i - 1];
+            i--;
+        }
+        values[i] = v;
+        counts[i] = count;
+    }
+    return found;
+}
+
+typedef struct {
+    LiveHistogram *histogram;
+    int threadIndex;
+    size_t valueCount;
+    atomic_int *running;
+} ProducerArgs;
+
+void *producerThread(void *args) {
+    ProducerArgs *producer = (ProducerArgs *)args;
+    unsigned int state = 2463534242u + producer->threadIndex;
+    int batch[LIVE_BATCH];
+
+    for (size_t done = 0; done < producer->valueCount; ) {
+        size_t length = producer->valueCount - done;
+        if (length > LIVE_BATCH) {
+            length = LIVE_BATCH;
+        }
+
+        // Skewed xorshift values so the top-k has something to find
+        for (size_t i = 0; i < length; i++) {
+            nextRandom(&state);
+            batch[i] = (state & 3) ? (int)(state % 16) : (int)((state >> 4) % (MAX_VALUE + 1));
+        }
+
+        histogramAddBatch(producer->histogram, producer->threadIndex, batch, length);
+        done += length;
+    }
+
+    atomic_fetch_sub(producer->running, 1);
+    return NULL;
+}
+
+int runLiveMode(void) {
+    struct timeval start, end;
+    double time_used;
+    int valuesPerProducer;
+
+    printf("\033[92m> numbers.c (live)\n");
+    printf("\nEnter the number of values per producer: ");
+    if (scanf("%d", &valuesPerProducer) != 1 || valuesPerProducer < 0) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+
+    LiveHistogram *histogram = createHistogram();
+    HistogramSnapshot *snapshot = malloc(sizeof(HistogramSnapshot));
+    if (histogram == NULL || snapshot == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(histogram);
+        free(snapshot);
+        return 1;
+    }
+
+    printf("\nStreaming values from %d producers...\n\n", NUM_THREADS);
+    gettimeofday(&start, NULL);
+
+    atomic_int running;
+    atomic_init(&running, NUM_THREADS);
+    pthread_t threads[NUM_THREADS];
+    ProducerArgs producers[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        producers[i].histogram = histogram;
+        producers[i].threadIndex = i;
+        producers[i].valueCount = valuesPerProducer;
+        producers[i].running = &running;
+        pthread_create(&threads[i], NULL, producerThread, (void *)&producers[i]);
+    }
+
+    // Query while the producers are still writing
+    int snapshots = 0;
+    while (atomic_load(&running) > 0) {
+        takeSnapshot(histogram, snapshot);
+        if (snapshots++ % 64 == 0) {
+            printf("  epoch %lu: %llu values, p50 %d, p99 %d\n", snapshot->epoch,
+                (unsigned long long)snapshot->total,
+                snapshotPercentile(snapshot, 50.0), snapshotPercentile(snapshot, 99.0));
+        }
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    takeSnapshot(histogram, snapshot);
+    gettimeofday(&end, NULL);
+
+    uint64_t expected = (uint64_t)valuesPerProducer * NUM_THREADS;
+    if (snapshot->total != expected) {
+        fprintf(stderr, "Lost values: %llu of %llu recorded\n",
+            (unsigned long long)snapshot->total, (unsigned long long)expected);
+        destroyHistogram(histogram);
+        free(snapshot);
+        return 1;
+    }
+
+    int topValues[LIVE_TOP_K];
+    uint64_t topCounts[LIVE_TOP_K];
+    int found = snapshotTopK(snapshot, LIVE_TOP_K, topValues, topCounts);
+
+    time_used = (end.tv_sec - start.tv_sec) * 1000.0;    // sec to ms
+    time_used += (end.tv_usec - start.tv_usec) / 1000.0; // us to ms
+    time_used /= 1000.0;
+
+    printf("\n\033[92mRecorded %llu values over %d snapshots!\n",
+        (unsigned long long)snapshot->total, snapshots + 1);
+    printf("\n\033[92m  - p50 %d, p90 %d, p99 %d, p99.9 %d",
+        snapshotPercentile(snapshot, 50.0), snapshotPercentile(snapshot, 90.0),
+        snapshotPercentile(snapshot, 99.0), snapshotPercentile(snapshot, 99.9));
+    printf("\n\033[92m  - Rank of 1000: %llu", (unsigned long long)snapshotRank(snapshot, 1000));
+    printf("\n\033[92m  - Top %d:", found);
+    for (int i = 0; i < found; i++) {
+        printf(" %d (%llu)", topValues[i], (unsigned long long)topCounts[i]);
+    }
+    printf("\n\033[92m  - Throughput: %.0f values/s\n\n", expected / time_used);
+
+    destroyHistogram(histogram);
+    free(snapshot);
+    return 0;
+}
+
+// ------------------------------
+// Multi-process sharded sample sort
+// ------------------------------
+
+// Worker processes stand in for nodes. Control messages go over a Unix-domain
+// socket per worker. The shared mapping stands in for the network: it holds
+// the partition size matrix and the exchange area that every worker scatters
+// its partitions into.
+typedef struct {
+    size_t counts[MAX_WORKERS][MAX_WORKERS]; // counts[source][destination]
+    int data[]; // Exchange area, laid out in destination order
+} ShardExchange;
+
+// Socket write that reports a dead peer as an error instead of raising SIGPIPE
+int writeAll(int fd, const void *buffer, size_t length) {
+    const char *bytes = buffer;
+    while (length > 0) {
+        ssize_t written = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return -1;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return 0;
+}
+
+int readAll(int fd, void *buffer, size_t length) {
+    char *bytes = buffer;
+    while (length > 0) {
+        ssize_t got = read(fd, bytes, length);
+        if (got <= 0) {
+            return -1;
+        }
+        bytes += got;
+        length -= got;
+    }
+    return 0;
+}
+
+int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Offset in the exchange area where source writes its partition for destination
+size_t exchangeOffset(const ShardExchange *exchange, int workers, int source, int destination) {
+    size_t offset = 0;
+    for (int d = 0; d < destination; d++) {
+        for (int s = 0; s < workers; s++) {
+            offset += exchange->counts[s][d];
+        }
+    }
+    for (int s = 0; s < source; s++) {
+        offset += exchange->counts[s][destination];
+    }
+    return offset;
+}
+
+// Body of worker process index; talks to the coordinator over socket
+int runShardWorker(int index, int workers, int socket, size_t localSize,
+                   ShardExchange *exchange, const char *prefix) {
+    // Each node starts with its own slice of the data
+    int *local = malloc((localSize ? localSize : 1) * sizeof(int));
+    if (local == NULL) {
+        return 1;
+    }
+    unsigned int state = 2463534242u + index;
+    for (size_t i = 0; i < localSize; i++) {
+        local[i] = nextRandom(&state) % (MAX_VALUE + 1);
+    }
+
+    // 1. Send a random sample of keys, get splitters back
+    int samples[SHARD_SAMPLES];
+    for (int i = 0; i < SHARD_SAMPLES; i++) {
+        samples[i] = localSize ? local[nextRandom(&state) % localSize] : MAX_VALUE;
+    }
+    int splitters[MAX_WORKERS - 1];
+    if (writeAll(socket, samples, sizeof(samples)) == -1
+        || readAll(socket, splitters, (workers - 1) * sizeof(int)) == -1) {
+        free(local);
+        return 1;
+    }
+
+    // 2. Local histogram, folded into one count per destination
+    static int histogram[MAX_VALUE + 1];
+    static unsigned char destinationOf[MAX_VALUE + 1];
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < localSize; i++) {
+        histogram[local[i]]++;
+    }
+    int destination = 0;
+    for (int v = 0; v <= MAX_VALUE; v++) {
+        while (destination < workers - 1 && v >= splitters[destination]) {
+            destination++;
+        }
+        destinationOf[v] = destination;
+    }
+    for (int d = 0; d < workers; d++) {
+        exchange->counts[index][d] = 0;
+    }
+    for (int v = 0; v <= MAX_VALUE; v++) {
+        exchange->counts[index][destinationOf[v]] += histogram[v];
+    }
+
+    // The histogram also lets the coordinator check the output against the input
+    char go;
+    if (writeAll(socket, histogram, sizeof(histogram)) == -1 || readAll(socket, &go, 1) == -1) {
+        free(local);
+        return 1;
+    }
+
+    // 3. All-to-all: scatter every partition into its destination's range
+    size_t slots[MAX_WORKERS];
+    for (int d = 0; d < workers; d++) {
+        slots[d] = exchangeOffset(exchange, workers, index, d);
+    }
+    for (size_t i = 0; i < localSize; i++) {
+        exchange->data[slots[destinationOf[local[i]]]++] = local[i];
+    }
+    free(local);
+
+    if (writeAll(socket, &go, 1) == -1 || readAll(socket, &go, 1) == -1) {
+        return 1;
+    }
+
+    // 4. Sort the received key range and write it out as this worker's shard
+    size_t start = exchangeOffset(exchange, workers, 0, index);
+    size_t received = 0;
+    for (int s = 0; s < workers; s++) {
+        received += exchange->counts[s][index];
+    }
+    int *range = exchange->data + start;
+
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < received; i++) {
+        histogram[range[i]]++;
+    }
+    sortArray(range, histogram);
+
+    char path[SMALL_PATH];
+    snprintf(path, sizeof(path), "%s.%d", prefix, index);
+    FILE *shard = fopen(path, "wb");
+    if (shard == NULL || fwrite(range, sizeof(int), received, shard) != received) {
+        perror(path);
+        if (shard) {
+            fclose(shard);
+        }
+        return 1;
+    }
+    fclose(shard);
+
+    unsigned long long done = received;
+    return writeAll(socket, &done, sizeof(done)) == -1;
+}
+
+int runShardMode(void) {
+    struct timeval start, end;
+    double time_used;
+    int workers;
+    char prefix[SMALL_PATH - 8];
+
+    printf("\033[92m> numbers.c (shard)\n");
+    printf("\nEnter the size of the array: ");
+    if (scanf("%d", &arraySize) != 1 || arraySize < 0) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+    printf("Enter the number of worker processes: ");
+    if (scanf("%d", &workers) != 1 || workers < 1 || workers > MAX_WORKERS) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+    printf("Enter the output shard prefix: ");
+    if (scanf("%247s", prefix) != 1) {
+        fprintf(stderr, "Invalid input\n");
+        return 1;
+    }
+
+    size_t exchangeSize = sizeof(ShardExchange) + (size_t)arraySize * sizeof(int);
+    ShardExchange *exchange = mmap(NULL, exchangeSize, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (exchange == MAP_FAILED) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+
+    printf("\nSorting %d numbers across %d worker processes...\n", arraySize, workers);
+    gettimeofday(&start, NULL);
+
+    int sockets[MAX_WORKERS];
+    pid_t pids[MAX_WORKERS];
+    int failed = 0;
+    for (int i = 0; i < workers; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+            perror("socketpair failed");
+            return 1;
+        }
+
+        size_t first = (size_t)arraySize * i / workers;
+        size_t last = (size_t)arraySize * (i + 1) / workers;
+
+        fflush(stdout);
+        pids[i] = fork();
+        if (pids[i] == -1) {
+            perror("fork failed");
+            return 1;
+        }
+        if (pids[i] == 0) {
+            close(pair[0]);
+            for (int j = 0; j < i; j++) {
+                close(sockets[j]);
+            }
+            _exit(runShardWorker(i, workers, pair[1], last - first, exchange, prefix));
+        }
+        close(pair[1]);
+        sockets[i] = pair[0];
+    }
+
+    // Choose splitters from the pooled samples
+    int *samples = malloc(workers * SHARD_SAMPLES * sizeof(int));
+    if (samples == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    for (int i = 0; i < workers; i++) {
+        if (readAll(sockets[i], samples + i * SHARD_SAMPLES, SHARD_SAMPLES * sizeof(int)) == -1) {
+            failed = 1;
+        }
+    }
+    qsort(samples, workers * SHARD_SAMPLES, sizeof(int), compareInts);
+    int splitters[MAX_WORKERS - 1];
+    for (int i = 0; i < workers - 1; i++) {
+        splitters[i] = samples[(i + 1) * SHARD_SAMPLES];
+    }
+    free(samples);
+    for (int i = 0; i < workers; i++) {
+        if (writeAll(sockets[i], splitters, (workers - 1) * sizeof(int)) == -1) {
+            failed = 1;
+        }
+    }
+
+    // Barrier: every count row is in place before anyone scatters. The
+    // workers' histograms add up to the histogram of the whole input.
+    static long long expected[MAX_VALUE + 1];
+    static int histogram[MAX_VALUE + 1];
+    memset(expected, 0, sizeof(expected));
+    char go = 1;
+    for (int i = 0; i < workers; i++) {
+        if (readAll(sockets[i], histogram, sizeof(histogram)) == -1) {
+            failed = 1;
+            continue;
+        }
+        for (int v = 0; v <= MAX_VALUE; v++) {
+            expected[v] += histogram[v];
+        }
+    }
+    for (int i = 0; i < workers && !failed; i++) {
+        if (writeAll(sockets[i], &go, 1) == -1) {
+            failed = 1;
+        }
+    }
+
+    // Barrier: every partition has landed before anyone sorts
+    for (int i = 0; i < workers && !failed; i++) {
+        if (readAll(sockets[i], &go, 1) == -1) {
+            failed = 1;
+        }
+    }
+    for (int i = 0; i < workers && !failed; i++) {
+        if (writeAll(sockets[i], &go, 1) == -1) {
+            failed = 1;
+        }
+    }
+
+    unsigned long long sorted = 0;
+    for (int i = 0; i < workers && !failed; i++) {
+        unsigned long long done;
+        if (readAll(sockets[i], &done, sizeof(done)) == -1) {
+            failed = 1;
+        } else {
+            sorted += done;
+        }
+    }
+
+    for (int i = 0; i < workers; i++) {
+        close(sockets[i]);
+    }
+    for (int i = 0; i < workers; i++) {
+        int status;
+        waitpid(pids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = 1;
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    if (failed) {
+        fprintf(stderr, "A worker process failed\n");
+        munmap(exchange, exchangeSize);
+        return 1;
+    }
+
+    // The shards laid end to end must be sorted, and a multiset of 16-bit
+    // values is a permutation of the input exactly when the histograms match
+    for (int i = 0; i < arraySize; i++) {
+        expected[exchange->data[i]]--;
+        if (i > 0 && exchange->data[i - 1] > exchange->data[i]) {
+            fprintf(stderr, "Output is not sorted at %d\n", i);
+            munmap(exchange, exchangeSize);
+            return 1;
+        }
+    }
+    munmap(exchange, exchangeSize);
+    int matches = sorted == (unsigned long long)arraySize;
+    for (int v = 0; v <= MAX_VALUE && matches; v++) {
+        matches = expected[v] == 0;
+    }
+    if (!matches) {
+        fprintf(stderr, "Output is not a permutation of the input\n");
+        return 1;
+    }
+
+    time_used = (end.tv_sec - start.tv_sec) * 1000.0;    // sec to ms
+    time_used += (end.tv_usec - start.tv_usec) / 1000.0; // us to ms
+
+    printf("\n\033[92mSorted random numbers into %d shards (%s.0 .. %s.%d)!\n",
+        workers, prefix, prefix, workers - 1);
+    printf("\n\033[92m  - Total execution time: %.3fms\n\n", time_used);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+        return runBatchMode();
+    }
+    if (argc > 1 && strcmp(argv[1], "live") == 0) {
+        return runLiveMode();
+    }
+    if (argc > 1 && strcmp(argv[1], "shard") == 0) {
+        return runShardMode();
+    }
+
     // Timer variables
     struct timeval start, end, start_total, end_total;
     double time_used, total_time_used;
@@ -1,12 +1,17 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
 #include <pthread.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <time.h>
 #include <sys/time.h>
 #include <asm-generic/socket.h>
@@ -17,11 +22,65 @@
 #define SMALL_BUFFER 1024
 #define ROOT_DIR "./www" // Define the root directory
 
+#define DEFAULT_MAX_CONNECTIONS 256 // Overridden by the first command line argument
+#define LISTEN_BACKLOG 128
+#define HANDLER_STACK_SIZE (256 * 1024) // Bounds memory per connection thread
+#define ACCEPT_PAUSE_MS 1000 // How long to wait for a free slot before shedding
+#define SHED_POLL_MS 50 // How often a shedding accept loop checks for a free slot
+
+// Connection timeouts, all enforced by the timer wheel
+#define HEADER_TIMEOUT_MS 10000 // Whole request header must arrive in this time
+#define BODY_TIMEOUT_MS 30000 // Whole request body must arrive in this time
+#define IDLE_TIMEOUT_MS 5000 // Longest silence allowed while reading
+#define WRITE_TIMEOUT_MS 10000 // Longest a send may make no progress
+
+#define WHEEL_SLOTS 512 // Slots in the timer wheel
+#define WHEEL_TICK_MS 100 // Time covered by one slot
+
+// Results of read_request besides a byte count
+#define READ_CLOSED 0
+#define READ_TIMEOUT -1
+#define READ_HEADER_TOO_LARGE -2
+#define READ_BODY_TOO_LARGE -3
+
+// Entry in the timer wheel; when it fires, the socket is shut down so the
+// blocked recv or send in the connection thread returns
+typedef struct timer_entry {
+    struct timer_entry *prev;
+    struct timer_entry *next;
+    int socket;
+    int shutdown_how; // SHUT_RD while reading, SHUT_RDWR while writing
+    size_t slot; // Slot the entry is linked into
+    unsigned long rounds; // Full wheel turns left before firing
+    int linked;
+    int expired;
+} timer_entry;
+
+// Hashed timer wheel: arming and cancelling are O(1), and each tick only
+// visits the connections hashed into one slot
+typedef struct {
+    timer_entry *slots[WHEEL_SLOTS];
+    unsigned long current; // Ticks processed so far
+    pthread_mutex_t mutex;
+} timer_wheel;
+
 typedef struct {
     int client_socket;
     struct sockaddr_in client_addr;
+    timer_entry timer;
 } client_info;
 
+timer_wheel wheel = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+// Timer of the connection served by the calling thread, re-armed by send_all
+_Thread_local timer_entry *current_timer = NULL;
+
+// Connection accounting for the max-connections cap
+int max_connections = DEFAULT_MAX_CONNECTIONS;
+int active_connections = 0;
+pthread_mutex_t connections_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t connection_closed = PTHREAD_COND_INITIALIZER;
+
 // Structure to map file extensions to MIME types
 typedef struct {
     const char *extension;
@@ -69,6 +128,125 @@ const char* get_mime_type(const char *path) {
     return "application/octet-stream"; // Default MIME type
 }
 
+// Monotonic clock in milliseconds
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Must be called with the wheel mutex held
+void timer_unlink(timer_entry *timer) {
+    if (!timer->linked) {
+        return;
+    }
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel.slots[timer->slot] = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = timer->next = NULL;
+    timer->linked = 0;
+}
+
+// Function to (re)arm a connection timer to fire after timeout_ms. A timer
+// that has fired stays inert until timer_cancel, so a read loop cannot
+// re-arm past its own timeout.
+void timer_arm(timer_entry *timer, long long timeout_ms, int shutdown_how) {
+    unsigned long ticks = (timeout_ms + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    pthread_mutex_lock(&wheel.mutex);
+    timer_unlink(timer);
+    if (!timer->expired) {
+        size_t slot = (wheel.current + ticks) % WHEEL_SLOTS;
+        timer->slot = slot;
+        timer->rounds = (ticks - 1) / WHEEL_SLOTS;
+        timer->shutdown_how = shutdown_how;
+        timer->prev = NULL;
+        timer->next = wheel.slots[slot];
+        if (timer->next) {
+            timer->next->prev = timer;
+        }
+        wheel.slots[slot] = timer;
+        timer->linked = 1;
+    }
+    pthread_mutex_unlock(&wheel.mutex);
+}
+
+// Function to disarm a connection timer; returns 1 if it had already fired.
+// Once this returns, the wheel no longer touches the socket, so it may be closed.
+// Cancelling ends the phase: the next timer_arm starts a fresh deadline.
+int timer_cancel(timer_entry *timer) {
+    pthread_mutex_lock(&wheel.mutex);
+    timer_unlink(timer);
+    int expired = timer->expired;
+    timer->expired = 0;
+    pthread_mutex_unlock(&wheel.mutex);
+    return expired;
+}
+
+// Thread that advances the wheel and expires due connections
+void *timer_thread(void *arg) {
+    (void)arg;
+    long long start = now_ms();
+    struct timespec tick = { 0, WHEEL_TICK_MS * 1000000L };
+
+    while (1) {
+        nanosleep(&tick, NULL);
+        unsigned long due = (now_ms() - start) / WHEEL_TICK_MS;
+
+        pthread_mutex_lock(&wheel.mutex);
+        while (wheel.current < due) {
+            wheel.current++;
+            timer_entry *timer = wheel.slots[wheel.current % WHEEL_SLOTS];
+            while (timer) {
+                timer_entry *next = timer->next;
+                if (timer->rounds > 0) {
+                    timer->rounds--;
+                    timer = next;
+                    continue;
+                }
+                timer_unlink(timer);
+                timer->expired = 1;
+                shutdown(timer->socket, timer->shutdown_how);
+                printf("Connection timed out (socket %d)\n", timer->socket);
+                timer = next;
+            }
+        }
+        pthread_mutex_unlock(&wheel.mutex);
+    }
+
+    return NULL;
+}
+
+// Function to send a whole buffer, re-arming the write timeout on progress
+int send_all(int client_socket, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        ssize_t sent = send(client_socket, bytes, length, MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += sent;
+        length -= sent;
+
+        // Any progress restarts the clock, so slow but steady clients finish
+        if (current_timer) {
+            timer_arm(current_timer, WRITE_TIMEOUT_MS, SHUT_RDWR);
+        }
+    }
+    return 0;
+}
+
 // Function to send HTTP responses with a message body
 void send_response(int client_socket, const char *status, const char *content_type, const void *body, size_t body_length) {
     char header[SMALL_BUFFER];
@@ -79,11 +257,11 @@ void send_response(int client_socket, const char *status, const char *content_ty
         "Connection: close\r\n\r\n",
         status, content_type, body_length);
 
-    if (send(client_socket, header, header_length, 0) == -1) {
+    if (send_all(client_socket, header, header_length) == -1) {
         perror("send header failed");
         return;
     }
-    if (send(client_socket, body, body_length, 0) == -1) {
+    if (send_all(client_socket, body, body_length) == -1) {
         perror("send body failed");
         return;
     }
@@ -99,7 +277,7 @@ void send_simple_response(int client_socket, const char *status, const char *con
         "Connection: close\r\n\r\n",
         status, content_type);
 
-    if (send(client_socket, header, header_length, 0) == -1) {
+    if (send_all(client_socket, header, header_length) == -1) {
         perror("send simple response failed");
     }
 }
@@ -298,7 +476,7 @@ void serve_static_file(int client_socket, const char *path) {
         mime_type, file_size);
 
     // Send headers
-    if (send(client_socket, header, header_length, 0) == -1) {
+    if (send_all(client_socket, header, header_length) == -1) {
         perror("send header failed");
         close(file_fd);
         return;
@@ -308,15 +486,10 @@ void serve_static_file(int client_socket, const char *path) {
     ssize_t bytes;
     char buffer[BUFFER_SIZE];
     while ((bytes = read(file_fd, buffer, BUFFER_SIZE)) > 0) {
-        ssize_t total_sent = 0;
-        while (total_sent < bytes) {
-            ssize_t sent = send(client_socket, buffer + total_sent, bytes - total_sent, 0);
-            if (sent == -1) {
-                perror("send failed");
-                close(file_fd);
-                return;
-            }
-            total_sent += sent;
+        if (send_all(client_socket, buffer, bytes) == -1) {
+            perror("send failed");
+            close(file_fd);
+            return;
         }
     }
 
@@ -341,6 +514,85 @@ void handle_post_ping(int client_socket, const char *body) {
     send_response(client_socket, "200 OK", "application/json", response_body, response_length);
 }
 
+// Function to read a request: headers first, then Content-Length bytes of body.
+// Returns the number of bytes read or one of the READ_* results.
+ssize_t read_request(client_info *cinfo, char *buffer, size_t size) {
+    size_t total = 0;
+    size_t expected = 0; // Header plus body length, known once the header is complete
+    long long deadline = now_ms() + HEADER_TIMEOUT_MS;
+
+    buffer[0] = '\0';
+    while (1) {
+        if (expected == 0) {
+            char *header_end = strstr(buffer, "\r\n\r\n");
+            if (header_end) {
+                size_t content_length = 0;
+                char *field = strcasestr(buffer, "\r\nContent-Length:");
+                if (field && field < header_end) {
+                    content_length = strtoul(field + strlen("\r\nContent-Length:"), NULL, 10);
+                }
+                expected = (header_end + 4 - buffer) + content_length;
+                if (expected > size - 1) {
+                    return READ_BODY_TOO_LARGE;
+                }
+                deadline = now_ms() + BODY_TIMEOUT_MS;
+            } else if (total >= size - 1) {
+                return READ_HEADER_TOO_LARGE;
+            }
+        }
+        if (expected != 0 && total >= expected) {
+            timer_cancel(&cinfo->timer);
+            return total;
+        }
+
+        long long remaining = deadline - now_ms();
+        if (remaining <= 0) {
+            return READ_TIMEOUT;
+        }
+        timer_arm(&cinfo->timer, remaining < IDLE_TIMEOUT_MS ? remaining : IDLE_TIMEOUT_MS, SHUT_RD);
+
+        ssize_t received = recv(cinfo->client_socket, buffer + total, size - 1 - total, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            if (timer_cancel(&cinfo->timer)) {
+                return READ_TIMEOUT;
+            }
+            if (received < 0) {
+                perror("recv failed");
+            }
+            return READ_CLOSED;
+        }
+        total += received;
+        buffer[total] = '\0';
+    }
+}
+
+// Function to give back a connection slot and wake the accept loop
+void release_connection_slot(void) {
+    pthread_mutex_lock(&connections_mutex);
+    active_connections--;
+    pthread_cond_signal(&connection_closed);
+    pthread_mutex_unlock(&connections_mutex);
+}
+
+// Function to turn away a client while overloaded, without spawning a thread
+void shed_connection(int client_socket) {
+    static const char response[] =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 0\r\n"
+        "Retry-After: 1\r\n"
+        "Connection: close\r\n\r\n";
+
+    // Never block the accept loop on a slow client
+    if (send(client_socket, response, sizeof(response) - 1, MSG_DONTWAIT | MSG_NOSIGNAL) == -1) {
+        perror("send 503 failed");
+    }
+    close(client_socket);
+}
+
 // Function to handle client requests
 void *handle_client(void *arg) {
     client_info *cinfo = (client_info *)arg;
@@ -348,15 +600,28 @@ void *handle_client(void *arg) {
     char buffer[BUFFER_SIZE];
     ssize_t received;
 
+    cinfo->timer.socket = client_socket;
+    current_timer = &cinfo->timer;
+
     // Receive data
-    received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-    if (received < 0) {
-        perror("recv failed");
+    received = read_request(cinfo, buffer, BUFFER_SIZE);
+    if (received <= 0) {
+        // End the read phase so the error response gets its own write timeout
+        timer_cancel(&cinfo->timer);
+        timer_arm(&cinfo->timer, WRITE_TIMEOUT_MS, SHUT_RDWR);
+        if (received == READ_TIMEOUT) {
+            send_simple_response(client_socket, "408 Request Timeout", "text/plain");
+        } else if (received == READ_HEADER_TOO_LARGE) {
+            send_simple_response(client_socket, "431 Request Header Fields Too Large", "text/plain");
+        } else if (received == READ_BODY_TOO_LARGE) {
+            send_simple_response(client_socket, "413 Payload Too Large", "text/plain");
+        }
+        timer_cancel(&cinfo->timer);
         close(client_socket);
         free(cinfo);
+        release_connection_slot();
         pthread_exit(NULL);
     }
-    buffer[received] = '\0';
 
     // Parse the request line
     char method[SMALL_BUFFER];
@@ -366,6 +631,9 @@ void *handle_client(void *arg) {
 
     printf("Received request: %s %s %s\n", method, path, protocol);
 
+    // Bound the time the response may stall
+    timer_arm(&cinfo->timer, WRITE_TIMEOUT_MS, SHUT_RDWR);
+
     // Route the request
     if (strcasecmp(method, "GET") == 0) {
         serve_static_file(client_socket, path);
@@ -388,16 +656,30 @@ void *handle_client(void *arg) {
         printf("Unsupported method or path: %s %s\n", method, path);
     }
 
+    timer_cancel(&cinfo->timer);
     close(client_socket);
     free(cinfo);
+    release_connection_slot();
     pthread_exit(NULL);
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     int server_fd;
     struct sockaddr_in address;
     int opt = 1;
 
+    // Optional connection cap from the command line
+    if (argc > 1) {
+        max_connections = atoi(argv[1]);
+        if (max_connections < 1) {
+            fprintf(stderr, "Usage: %s [max_connections]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Peers closing mid-response must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
     // Create socket file descriptor (IPv4, TCP)
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
         perror("socket failed");
@@ -426,35 +708,111 @@ int main() {
     }
 
     // Start listening for incoming connections
-    if (listen(server_fd, 16) < 0) {
+    if (listen(server_fd, LISTEN_BACKLOG) < 0) {
         perror("listen failed");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
 
-    printf("HTTP Server is running on port %d\n", PORT);
+    // Non-blocking so an overloaded server can drain its backlog; accepted
+    // sockets do not inherit the flag
+    if (fcntl(server_fd, F_SETFL, fcntl(server_fd, F_GETFL) | O_NONBLOCK) == -1) {
+        perror("fcntl failed");
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Start the timer wheel
+    pthread_t timer_tid;
+    if (pthread_create(&timer_tid, NULL, timer_thread, NULL) != 0) {
+        perror("pthread_create failed");
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(timer_tid);
+
+    // Small fixed stacks keep memory bounded by max_connections
+    pthread_attr_t handler_attr;
+    pthread_attr_init(&handler_attr);
+    pthread_attr_setstacksize(&handler_attr, HANDLER_STACK_SIZE);
+
+    printf("HTTP Server is running on port %d (max %d connections)\n", PORT, max_connections);
 
     // Main loop to accept incoming connections
+    int overloaded = 0;
     while (1) {
-        client_info *cinfo = malloc(sizeof(client_info));
-        if (!cinfo) {
-            perror("malloc failed");
+        // Pause accepting while at capacity. If no slot frees up within the
+        // grace period the server turns overloaded and stays that way, shedding
+        // every queued client with a 503, until a slot frees again.
+        int reserved = 0;
+        pthread_mutex_lock(&connections_mutex);
+        if (active_connections < max_connections) {
+            overloaded = 0;
+        } else if (!overloaded) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += ACCEPT_PAUSE_MS / 1000;
+            until.tv_nsec += (ACCEPT_PAUSE_MS % 1000) * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            while (active_connections >= max_connections) {
+                if (pthread_cond_timedwait(&connection_closed, &connections_mutex, &until) == ETIMEDOUT) {
+                    break;
+                }
+            }
+            overloaded = active_connections >= max_connections;
+        }
+        if (!overloaded) {
+            active_connections++; // Reserve the slot before accepting
+            reserved = 1;
+        }
+        pthread_mutex_unlock(&connections_mutex);
+
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int client_socket = accept(server_fd, (struct sockaddr *)&client_addr, &addr_len);
+        if (client_socket < 0) {
+            int accept_errno = errno;
+            if (reserved) {
+                release_connection_slot();
+            }
+            if (accept_errno != EAGAIN && accept_errno != EWOULDBLOCK && accept_errno != EINTR) {
+                perror("accept failed");
+                continue;
+            }
+
+            // Backlog is empty: wait for a client, and while overloaded wake
+            // up regularly to notice a freed slot
+            struct pollfd ready = { .fd = server_fd, .events = POLLIN };
+            poll(&ready, 1, overloaded ? SHED_POLL_MS : -1);
             continue;
         }
-        socklen_t addr_len = sizeof(cinfo->client_addr);
-        cinfo->client_socket = accept(server_fd, (struct sockaddr *)&cinfo->client_addr, &addr_len);
-        if (cinfo->client_socket < 0) {
-            perror("accept failed");
-            free(cinfo);
+
+        if (!reserved) {
+            printf("Overloaded: shedding connection\n");
+            shed_connection(client_socket);
+            continue;
+        }
+
+        client_info *cinfo = calloc(1, sizeof(client_info));
+        if (!cinfo) {
+            perror("malloc failed");
+            shed_connection(client_socket);
+            release_connection_slot();
             continue;
         }
+        cinfo->client_socket = client_socket;
+        cinfo->client_addr = client_addr;
 
         // Create a new thread to handle the client
         pthread_t tid;
-        if (pthread_create(&tid, NULL, handle_client, (void *)cinfo) != 0) {
+        if (pthread_create(&tid, &handler_attr, handle_client, (void *)cinfo) != 0) {
             perror("pthread_create failed");
-            close(cinfo->client_socket);
+            shed_connection(cinfo->client_socket);
             free(cinfo);
+            release_connection_slot();
             continue;
         }
 
@@ -462,6 +820,7 @@ int main() {
         pthread_detach(tid);
     }
 
+    pthread_attr_destroy(&handler_attr);
     close(server_fd);
     return 0;
 }
\ No newline at end of file